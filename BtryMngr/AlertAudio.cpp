@@ -0,0 +1,241 @@
+#include "AlertAudio.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+
+#pragma comment(lib, "winmm.lib")
+#endif
+
+namespace {
+
+const double two_pi = 6.283185307179586476925286766559;
+const double max_amplitude = 32760;  // "volume"
+
+// One cycle of the sine at full amplitude. A 32-bit phase accumulator indexes
+// it with its top bits and interpolates between entries with the rest, which
+// keeps every sample within a couple of LSB of std::sin.
+const int wavetableBits = 12;
+const int fractionBits = 32 - wavetableBits;
+
+const std::array<short, 1 << wavetableBits>& SineTable() {
+    static const std::array<short, 1 << wavetableBits> table = [] {
+        std::array<short, 1 << wavetableBits> t{};
+        for (std::size_t i = 0; i < t.size(); ++i) {
+            t[i] = static_cast<short>(max_amplitude * std::sin(two_pi * i / t.size()));
+        }
+        return t;
+    }();
+    return table;
+}
+
+}
+
+const AudioClip& ToneCache::Tone(double frequency, int durationMs, int repeats, int gapMs) {
+    static const AudioClip silence;
+    if (frequency <= 0 || durationMs <= 0 || repeats < 1 || gapMs < 0) {
+        return silence;
+    }
+
+    auto key = std::make_tuple(frequency, durationMs, repeats, gapMs);
+    auto found = clips.find(key);
+    if (found != clips.end()) {
+        return found->second;
+    }
+
+    const auto& table = SineTable();
+    std::size_t toneSamples = static_cast<std::size_t>(audioSampleRate) * durationMs / 1000;
+    std::size_t gapSamples = static_cast<std::size_t>(audioSampleRate) * gapMs / 1000;
+    uint32_t step = static_cast<uint32_t>(frequency / audioSampleRate * 4294967296.0);
+
+    AudioClip& clip = clips[key];
+    clip.resize(repeats * (toneSamples + gapSamples));
+
+    // Every beep starts at phase zero, so render one and copy it.
+    uint32_t phase = 0;
+    for (std::size_t i = 0; i < toneSamples; ++i) {
+        uint32_t index = phase >> fractionBits;
+        int32_t fraction = static_cast<int32_t>(phase & ((1u << fractionBits) - 1));
+        int32_t a = table[index];
+        int32_t b = table[(index + 1) & (table.size() - 1)];
+        clip[i] = static_cast<short>(a + ((b - a) * fraction >> fractionBits));
+        phase += step;
+    }
+    for (int r = 1; r < repeats; ++r) {
+        std::copy(clip.begin(), clip.begin() + toneSamples, clip.begin() + r * (toneSamples + gapSamples));
+    }
+    return clip;
+}
+
+AudioClip RenderToneReference(double frequency, int durationMs, int repeats, int gapMs) {
+    if (frequency <= 0 || durationMs <= 0 || repeats < 1 || gapMs < 0) {
+        return AudioClip();
+    }
+
+    std::size_t toneSamples = static_cast<std::size_t>(audioSampleRate) * durationMs / 1000;
+    std::size_t gapSamples = static_cast<std::size_t>(audioSampleRate) * gapMs / 1000;
+    AudioClip clip(repeats * (toneSamples + gapSamples));
+    for (int r = 0; r < repeats; ++r) {
+        short* beep = clip.data() + r * (toneSamples + gapSamples);
+        for (std::size_t i = 0; i < toneSamples; ++i) {
+            beep[i] = static_cast<short>(max_amplitude * std::sin(frequency * two_pi * i / audioSampleRate));
+        }
+    }
+    return clip;
+}
+
+#ifdef _WIN32
+
+namespace {
+
+// Keeps one waveOut handle open and waits on its completion event.
+class WaveOutSink : public AudioSink {
+public:
+    WaveOutSink() {
+        done = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        WAVEFORMATEX wfx = { WAVE_FORMAT_PCM, 1, audioSampleRate, audioSampleRate * 2, 2, 16, 0 };
+        if (waveOutOpen(&hwo, WAVE_MAPPER, &wfx, reinterpret_cast<DWORD_PTR>(done), 0, CALLBACK_EVENT) != MMSYSERR_NOERROR) {
+            hwo = nullptr;
+        }
+    }
+
+    ~WaveOutSink() override {
+        if (hwo) {
+            waveOutReset(hwo);
+            waveOutClose(hwo);
+        }
+        CloseHandle(done);
+    }
+
+    void Play(const AudioClip& clip) override {
+        if (!hwo || clip.empty()) {
+            return;
+        }
+        WAVEHDR hdr = { 0 };
+        hdr.lpData = reinterpret_cast<LPSTR>(const_cast<short*>(clip.data()));
+        hdr.dwBufferLength = static_cast<DWORD>(clip.size() * sizeof(short));
+        waveOutPrepareHeader(hwo, &hdr, sizeof(hdr));
+        if (waveOutWrite(hwo, &hdr, sizeof(hdr)) == MMSYSERR_NOERROR) {
+            while (!(hdr.dwFlags & WHDR_DONE)) {
+                WaitForSingleObject(done, INFINITE);
+            }
+        }
+        waveOutUnprepareHeader(hwo, &hdr, sizeof(hdr));
+    }
+
+private:
+    HWAVEOUT hwo = nullptr;
+    HANDLE done = nullptr;
+};
+
+}
+
+std::unique_ptr<AudioSink> CreateWaveOutSink() {
+    return std::make_unique<WaveOutSink>();
+}
+
+#endif
+
+namespace {
+
+// Appends everything played to a single WAV file, keeping the header sizes
+// current so the file is valid whenever it is read.
+class WavFileSink : public AudioSink {
+public:
+    explicit WavFileSink(const std::string& path) : file(path, std::ios::binary) {
+        WriteHeader();
+    }
+
+    void Play(const AudioClip& clip) override {
+        if (!file) {
+            return;
+        }
+        file.seekp(0, std::ios::end);
+        for (short sample : clip) {
+            WriteLittleEndian(static_cast<uint16_t>(sample), 2);
+        }
+        dataBytes += static_cast<uint32_t>(clip.size() * sizeof(short));
+        file.seekp(0);
+        WriteHeader();
+        file.flush();
+    }
+
+private:
+    void WriteHeader() {
+        file.write("RIFF", 4);
+        WriteLittleEndian(36 + dataBytes, 4);
+        file.write("WAVEfmt ", 8);
+        WriteLittleEndian(16, 4);                    // fmt chunk size
+        WriteLittleEndian(1, 2);                     // PCM
+        WriteLittleEndian(1, 2);                     // mono
+        WriteLittleEndian(audioSampleRate, 4);
+        WriteLittleEndian(audioSampleRate * 2, 4);   // byte rate
+        WriteLittleEndian(2, 2);                     // block align
+        WriteLittleEndian(16, 2);                    // bits per sample
+        file.write("data", 4);
+        WriteLittleEndian(dataBytes, 4);
+    }
+
+    void WriteLittleEndian(uint32_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            file.put(static_cast<char>((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    std::ofstream file;
+    uint32_t dataBytes = 0;
+};
+
+}
+
+std::unique_ptr<AudioSink> CreateWavFileSink(const std::string& path) {
+    return std::make_unique<WavFileSink>(path);
+}
+
+AudioQueue::AudioQueue(std::unique_ptr<AudioSink> sink, std::size_t maxPending)
+    : sink(std::move(sink)), maxPending(maxPending), worker(&AudioQueue::Run, this) {
+}
+
+AudioQueue::~AudioQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    worker.join();
+}
+
+bool AudioQueue::Enqueue(const AudioClip& clip) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.size() >= maxPending) {
+            ++dropped;
+            return false;
+        }
+        pending.push_back(&clip);
+    }
+    wake.notify_one();
+    return true;
+}
+
+void AudioQueue::Run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty()) {
+            return;
+        }
+        const AudioClip* clip = pending.front();
+        pending.pop_front();
+
+        lock.unlock();
+        sink->Play(*clip);
+        lock.lock();
+    }
+}
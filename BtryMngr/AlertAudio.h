@@ -0,0 +1,92 @@
+/*
+AlertAudio: alert sounds for BtryMngr.
+
+ToneCache renders each alert once (from a sine wavetable rather than calling
+std::sin per sample) and keeps the PCM around. AudioQueue plays clips on its
+own thread through a sink that stays open for the life of the program, so the
+monitor loop only pays for pushing a pointer onto a queue.
+
+Sinks: the waveOut device on Windows, or a WAV file for running headless.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+const int audioSampleRate = 44100;  // 16-bit mono PCM throughout
+
+using AudioClip = std::vector<short>;
+
+// Not thread safe: use from the monitor thread only. Returned clips live as
+// long as the cache.
+class ToneCache {
+public:
+    // An empty clip for a non-positive frequency, duration or repeat count.
+    const AudioClip& Tone(double frequency, int durationMs, int repeats = 1, int gapMs = 0);
+
+    // The BtryMngr alert: `count` 100 ms beeps at 3500 Hz, 70 ms apart.
+    const AudioClip& Beeps(int count) { return Tone(3500, 100, count, 70); }
+
+private:
+    std::map<std::tuple<double, int, int, int>, AudioClip> clips;
+};
+
+// Renders the same clip as ToneCache::Tone with a std::sin call per sample,
+// as BtryMngr did before the wavetable. Kept as the reference the wavetable is
+// tested and benchmarked against.
+AudioClip RenderToneReference(double frequency, int durationMs, int repeats = 1, int gapMs = 0);
+
+class AudioSink {
+public:
+    virtual ~AudioSink() = default;
+
+    // Blocks until the clip has been played (or written).
+    virtual void Play(const AudioClip& clip) = 0;
+};
+
+#ifdef _WIN32
+std::unique_ptr<AudioSink> CreateWaveOutSink();
+#endif
+
+std::unique_ptr<AudioSink> CreateWavFileSink(const std::string& path);
+
+// Plays queued clips in order on a worker thread. Enqueue() never blocks on
+// the device; clips beyond maxPending are dropped rather than piling up.
+class AudioQueue {
+public:
+    explicit AudioQueue(std::unique_ptr<AudioSink> sink, std::size_t maxPending = 8);
+
+    // Plays everything still queued before returning.
+    ~AudioQueue();
+
+    AudioQueue(const AudioQueue&) = delete;
+    AudioQueue& operator=(const AudioQueue&) = delete;
+
+    // The clip must outlive its playback.
+    bool Enqueue(const AudioClip& clip);
+
+    // Clips refused by Enqueue because the queue was full.
+    std::size_t Dropped() const { return dropped; }
+
+private:
+    void Run();
+
+    std::unique_ptr<AudioSink> sink;
+    std::size_t maxPending;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<const AudioClip*> pending;
+    std::atomic<std::size_t> dropped{ 0 };
+    bool stopping = false;
+    std::thread worker;
+};
@@ -6,11 +6,17 @@ level reaches certain thresholds and displays the current battery percentage
 as a large message on the screen. The program also attempts to add itself to
 the user's startup applications to run automatically upon system boot.
 The main functionalities of this program are:
-Monitoring battery status and charging state using the Windows API.
+Monitoring battery status and charging state using the Windows API. The
+monitor sleeps until Windows sends a power notification rather than polling
+(see PowerSource.h); on Linux it builds as a headless console tool that
+reads /sys/class/power_supply or a fake copy of it.
 Displaying a large, temporary, semi-transparent message on the screen
 with the current battery percentage.
 Emitting a beep sound when the battery level reaches 95% and the
-device is connected to AC power.
+device is connected to AC power. Beeps are rendered once and played from
+a queue on their own thread (see AlertAudio.h) so monitoring never waits.
+Keeping a history of battery readings, written to
+%LOCALAPPDATA%\BtryMonitor\history.csv whenever an alert fires.
 Adding the program to the user's startup applications using the
 Windows registry (if not already added).
 The program uses a combination of WINAPI functions, multithreading, and
@@ -24,12 +30,17 @@ Author: Xus
 
 #include <iostream>
 #include <string>
-#include <windows.h>
 #include <thread>
 #include <chrono>
-#include <shlwapi.h>
+#include <fstream>
+#include "AlertAudio.h"
+#include "FleetMonitor.h"
+#include "PowerMonitor.h"
+
+#ifdef _WIN32
 
-#pragma comment(lib, "winmm.lib")
+#include <windows.h>
+#include <shlwapi.h>
 
 bool IsMonitorOffDueToInactivity() {
     LASTINPUTINFO lii;
@@ -50,45 +61,8 @@ bool IsMonitorOffDueToInactivity() {
     return (idleTime > monitorTimeoutMs);
 }
 
-bool GetBatteryStatus(SYSTEM_POWER_STATUS& sps) {
-    return GetSystemPowerStatus(&sps) != 0;
-}
 
 
-
-const double two_pi = 6.283185307179586476925286766559;
-const double max_amplitude = 32760;  // "volume"
-
-void SineWaveBeep(double frequency, int duration) {
-    HWAVEOUT hwo;
-    WAVEFORMATEX wfx = { WAVE_FORMAT_PCM, 1, 44100, 44100, 2, 16, 0 };
-    waveOutOpen(&hwo, WAVE_MAPPER, &wfx, 0, 0, CALLBACK_NULL);
-
-    int samples = static_cast<int>(wfx.nSamplesPerSec * duration / 1000);
-    int dataSize = samples * sizeof(short);
-    short* data = new short[samples];
-
-    for (int i = 0; i < samples; ++i) {
-        data[i] = static_cast<short>(max_amplitude * std::sin(frequency * two_pi * i / wfx.nSamplesPerSec));
-    }
-
-    WAVEHDR hdr = { reinterpret_cast<LPSTR>(data), dataSize, 0, 0, 0, 0, 0, 0 };
-    waveOutPrepareHeader(hwo, &hdr, sizeof(hdr));
-    waveOutWrite(hwo, &hdr, sizeof(hdr));
-    std::this_thread::sleep_for(std::chrono::milliseconds(duration));
-    waveOutUnprepareHeader(hwo, &hdr, sizeof(hdr));
-
-    delete[] data;
-    waveOutClose(hwo);
-}
-
-void Beeps(int j) {
-    for (int i = 0; i < j; ++i) {
-        SineWaveBeep(3500, 100);
-        std::this_thread::sleep_for(std::chrono::milliseconds(70));
-    }
-}
-
 LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
     std::wstring* msg = reinterpret_cast<std::wstring*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
     switch (message) {
@@ -194,49 +168,318 @@ bool AddToStartup() {
 }
 
 
+// Where WinMain keeps the battery history for fleet analysis:
+// %LOCALAPPDATA%\BtryMonitor\history.csv, in PowerHistory's CSV format.
+std::wstring HistoryPath() {
+    WCHAR appData[MAX_PATH];
+    DWORD len = GetEnvironmentVariableW(L"LOCALAPPDATA", appData, MAX_PATH);
+    if (len == 0 || len >= MAX_PATH) {
+        return L"";
+    }
+    std::wstring dir = std::wstring(appData) + L"\\BtryMonitor";
+    CreateDirectoryW(dir.c_str(), nullptr);
+    return dir + L"\\history.csv";
+}
+
+void ExportHistory(const PowerMonitor& monitor, const std::wstring& path) {
+    if (path.empty()) {
+        return;
+    }
+    std::ofstream out(path.c_str());
+    monitor.GetHistory().WriteCsv(out);
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
-    Beeps(1);
+    ToneCache tones;
+    AudioQueue audio(CreateWaveOutSink());
+    audio.Enqueue(tones.Beeps(1));
     if (!AddToStartup()) {
         MessageBox(NULL, L"Failed to add the program to startup. Please run this program as an administrator.", L"Error", MB_OK | MB_ICONERROR);
     }
 
-    int prevBatteryPercent = 0;
-    while (true) {
-        SYSTEM_POWER_STATUS sps;
-        if (GetBatteryStatus(sps)) {
-            int currentBatteryPercent = sps.BatteryLifePercent;
-            bool isConnectedToAC = sps.ACLineStatus == 1;
-            bool isBatteryPercentDifferenceSmall = std::abs(currentBatteryPercent - prevBatteryPercent) < 5;
-
-            bool inNormalRange = currentBatteryPercent < 95 && currentBatteryPercent > 31;
-            bool connectedToACAndLowBattery = isConnectedToAC && currentBatteryPercent < 32;
-            bool notConnectedToACAndHighBattery = !isConnectedToAC && currentBatteryPercent > 94;
-            bool notConnectedToACAndLowBattery = !isConnectedToAC && currentBatteryPercent < 32;
-            bool connectedToACAndHighBattery = isConnectedToAC && currentBatteryPercent > 94;
-            bool safezone = inNormalRange || connectedToACAndLowBattery || notConnectedToACAndHighBattery;
-
-            if (safezone && isBatteryPercentDifferenceSmall) {
-                std::this_thread::sleep_for(std::chrono::minutes(2));
-                continue;
-            }
+    std::unique_ptr<PowerSource> source = CreateSystemPowerSource();
+    PowerMonitor monitor(*source);
+    std::wstring historyPath = HistoryPath();
+    PowerState state;
+    AlertDecision decision;
+    while (monitor.WaitForAlert(state, decision) == MonitorResult::Alert) {
+        ExportHistory(monitor, historyPath);
 
-            if (notConnectedToACAndLowBattery || connectedToACAndHighBattery) {
-                    Beeps(2);
-            }
+        if (decision.beep) {
+            audio.Enqueue(tones.Beeps(2));
+        }
 
-             std::wstring batteryPercentStr = std::to_wstring(currentBatteryPercent) + L"%";
-             if (!IsMonitorOffDueToInactivity()) {
-                 ShowBigMessage(batteryPercentStr);
-             }
+        std::wstring batteryPercentStr = std::to_wstring(state.batteryPercent) + L"%";
+        if (!IsMonitorOffDueToInactivity()) {
+            ShowBigMessage(batteryPercentStr);
+        }
+    }
+
+    ExportHistory(monitor, historyPath);
+    MessageBox(NULL, L"Failed to Get Battery Status", L"Error", MB_OK | MB_ICONERROR);
+    return 1;
+}
 
-            std::this_thread::sleep_for(std::chrono::minutes(1));
-            prevBatteryPercent = currentBatteryPercent;
+#else
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+
+// Parses a non-negative integer flag value, rejecting trailing junk.
+bool ParseNumber(const char* text, long long& value) {
+    char* end = nullptr;
+    errno = 0;
+    long long parsed = std::strtoll(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || parsed < 0) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+// --bench-audio: times rendering an alert with the wavetable against the
+// std::sin loop it replaced, and the cost of queuing it for playback.
+int RunAudioBenchmark(long long iterations) {
+    using BenchClock = std::chrono::steady_clock;
+    // Keeps the renders from being optimised away.
+    volatile short keep = 0;
+
+    // The per-sample std::sin loop SineWaveBeep used.
+    auto start = BenchClock::now();
+    for (long long n = 0; n < iterations; ++n) {
+        keep = RenderToneReference(3500, 100, 2, 70)[100];
+    }
+    double sinUs = std::chrono::duration<double, std::micro>(BenchClock::now() - start).count() / iterations;
+
+    // Rendering through a fresh cache each time, so nothing is reused.
+    start = BenchClock::now();
+    for (long long n = 0; n < iterations; ++n) {
+        ToneCache tones;
+        keep = tones.Beeps(2)[100];
+    }
+    static_cast<void>(keep);
+    double tableUs = std::chrono::duration<double, std::micro>(BenchClock::now() - start).count() / iterations;
+
+    // What the monitor pays per alert once the clip is cached.
+    ToneCache tones;
+    const AudioClip& clip = tones.Beeps(2);
+    double enqueueUs = 0;
+    double worstUs = 0;
+    std::size_t dropped = 0;
+    {
+        AudioQueue audio(CreateWavFileSink("/dev/null"), static_cast<std::size_t>(iterations));
+        for (long long n = 0; n < iterations; ++n) {
+            auto before = BenchClock::now();
+            audio.Enqueue(clip);
+            double us = std::chrono::duration<double, std::micro>(BenchClock::now() - before).count();
+            enqueueUs += us;
+            worstUs = std::max(worstUs, us);
         }
-        else {
-            MessageBox(NULL, L"Failed to Get Battery Status", L"Error", MB_OK | MB_ICONERROR);
-            return 1;
+        dropped = audio.Dropped();
+    }
+
+    std::cout << "render std::sin: " << sinUs << " us/alert" << std::endl;
+    std::cout << "render wavetable: " << tableUs << " us/alert" << std::endl;
+    std::cout << "enqueue: " << enqueueUs / iterations << " us avg, " << worstUs << " us max, "
+        << dropped << " dropped" << std::endl;
+    return 0;
+}
+
+// --fleet: watches every device under root and reports the cost per source.
+int RunFleet(const std::string& root, long long generate, long long pollMs, long long seconds) {
+    if (generate > 0 && !GenerateFleetTree(root, static_cast<std::size_t>(generate))) {
+        std::cerr << "Failed to generate fleet under " << root << std::endl;
+        return 1;
+    }
+
+    // A tick of a sixteenth of the poll interval (at least 1 ms) gives the
+    // wheel enough slots per poll to spread the sources out, while keeping it
+    // to at most a minute's worth of 1 ms slots however long the poll is.
+    auto pollInterval = std::chrono::milliseconds(pollMs);
+    auto realertInterval = std::max<std::chrono::milliseconds>(pollInterval, std::chrono::minutes(1));
+    auto tick = std::max<std::chrono::milliseconds>(pollInterval / 16, std::chrono::milliseconds(1));
+    FleetMonitor fleet(pollInterval, realertInterval, tick);
+    std::size_t found = fleet.Discover(root);
+    std::cout << "sources: " << found << std::endl;
+    if (found == 0) {
+        return 1;
+    }
+
+    long long alerts = 0;
+    long long batches = 0;
+    auto until = seconds > 0 ? FleetMonitor::Clock::now() + std::chrono::seconds(seconds) : FleetMonitor::Clock::time_point::max();
+    std::clock_t cpuStart = std::clock();
+    auto wallStart = FleetMonitor::Clock::now();
+    fleet.Run(until, [&](const FleetMonitor::AlertBatch& batch) {
+        ++batches;
+        alerts += batch.size();
+        for (const FleetAlert& alert : batch) {
+            std::cout << fleet.Path(alert.source) << " " << (alert.decision.beep ? "beep " : "")
+                << alert.state.batteryPercent << "% " << (alert.state.isConnectedToAC ? "AC" : "battery") << "\n";
+        }
+        std::cout.flush();
+    });
+    double cpuSeconds = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    double wallSeconds = std::chrono::duration<double>(FleetMonitor::Clock::now() - wallStart).count();
+
+    std::cout << "polls: " << fleet.Polls() << ", failures: " << fleet.Failures()
+        << ", alerts: " << alerts << " in " << batches << " batches" << std::endl;
+    std::cout << "cpu: " << cpuSeconds << "s over " << wallSeconds << "s ("
+        << (fleet.Polls() > 0 ? cpuSeconds * 1e6 / fleet.Polls() : 0) << " us/poll)" << std::endl;
+    std::cout << "memory: " << fleet.MemoryBytes() / found << " bytes/source" << std::endl;
+    return 0;
+}
+
+// Headless mode for Linux: prints alerts instead of beeping and drawing, and
+// reports how often the monitor woke up. Point --sysfs at a fake
+// /sys/class/power_supply tree to drive the thresholds from a script, or
+// --replay at a recorded CSV trace to run it through on a virtual clock.
+// --export-csv / --export-bin write the collected history on exit, and --wav
+// sends the alert beeps through the audio queue into a WAV file.
+// --realert-ms and --max-wait-ms override PowerMonitor's re-alert interval and
+// longest wait, so a script can walk a fake tree through several thresholds.
+//
+// --bench-audio <n> renders the alert n times with the tone cache's wavetable
+// and with the per-sample std::sin loop it replaced, then times n enqueues.
+//
+// --fleet <dir> instead watches every device under dir (see FleetMonitor.h),
+// printing alerts a tick at a time and the CPU and memory cost per source.
+// --generate <n> first fills dir with n fake devices; --poll-ms sets the poll
+// interval, up to a day.
+int main(int argc, char* argv[]) {
+    std::string sysfsRoot;
+    std::string replayPath;
+    std::string csvPath;
+    std::string binPath;
+    std::string wavPath;
+    std::string fleetRoot;
+    long long generate = 0;
+    long long pollMs = 60 * 1000;
+    const long long maxPollMs = 24 * 60 * 60 * 1000LL;
+    long long seconds = 0;
+    long long realertMs = 60 * 1000;
+    long long maxWaitMs = 10 * 60 * 1000;
+    long long benchAudio = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        bool valid = true;
+        if (arg == "--sysfs") {
+            sysfsRoot = argv[i + 1];
+        }
+        else if (arg == "--replay") {
+            replayPath = argv[i + 1];
+        }
+        else if (arg == "--export-csv") {
+            csvPath = argv[i + 1];
+        }
+        else if (arg == "--export-bin") {
+            binPath = argv[i + 1];
+        }
+        else if (arg == "--wav") {
+            wavPath = argv[i + 1];
+        }
+        else if (arg == "--fleet") {
+            fleetRoot = argv[i + 1];
+        }
+        else if (arg == "--generate") {
+            valid = ParseNumber(argv[i + 1], generate);
+        }
+        else if (arg == "--poll-ms") {
+            valid = ParseNumber(argv[i + 1], pollMs) && pollMs > 0 && pollMs <= maxPollMs;
+        }
+        else if (arg == "--seconds") {
+            valid = ParseNumber(argv[i + 1], seconds);
+        }
+        else if (arg == "--bench-audio") {
+            valid = ParseNumber(argv[i + 1], benchAudio) && benchAudio > 0;
+        }
+        else if (arg == "--realert-ms") {
+            valid = ParseNumber(argv[i + 1], realertMs) && realertMs > 0;
+        }
+        else if (arg == "--max-wait-ms") {
+            valid = ParseNumber(argv[i + 1], maxWaitMs) && maxWaitMs > 0;
         }
+        if (!valid) {
+            std::cerr << "Invalid value for " << arg << ": " << argv[i + 1] << std::endl;
+            return 2;
+        }
+    }
+
+    if (benchAudio > 0) {
+        return RunAudioBenchmark(benchAudio);
+    }
+    if (!fleetRoot.empty()) {
+        return RunFleet(fleetRoot, generate, pollMs, seconds);
+    }
+
+    std::unique_ptr<PowerSource> source;
+    if (!replayPath.empty()) {
+        source = CreateReplayPowerSource(replayPath);
+    }
+    else if (!sysfsRoot.empty()) {
+        source = CreateSysfsPowerSource(sysfsRoot, true);
+    }
+    else {
+        source = CreateSystemPowerSource();
+    }
+    PowerMonitor monitor(*source, std::chrono::milliseconds(maxWaitMs), std::chrono::milliseconds(realertMs));
+    ToneCache tones;
+    std::unique_ptr<AudioQueue> audio;
+    if (!wavPath.empty()) {
+        audio = std::make_unique<AudioQueue>(CreateWavFileSink(wavPath));
+    }
+    auto until = seconds > 0 ? source->Now() + std::chrono::seconds(seconds) : PowerMonitor::Clock::time_point::max();
+
+    PowerState state;
+    AlertDecision decision;
+    MonitorResult result;
+    auto start = source->Now();
+    long long beepAlerts = 0;
+    while ((result = monitor.WaitForAlert(state, decision, until)) == MonitorResult::Alert) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(source->Now() - start).count();
+        std::cout << elapsed << "s " << (decision.beep ? "beep " : "") << state.batteryPercent << "% "
+            << (state.isConnectedToAC ? "AC" : "battery");
+        if (decision.beep && audio) {
+            audio->Enqueue(tones.Beeps(2));
+            ++beepAlerts;
+        }
+
+        // The trend, and when it reaches the alert threshold for this plug state.
+        const PowerMonitor::History& history = monitor.GetHistory();
+        double rate;
+        if (history.EstimateRate(rate, PowerMonitor::rateWindowMs)) {
+            std::cout << " " << rate << "%/h";
+            int threshold = state.isConnectedToAC ? 95 : 31;
+            int64_t ms;
+            if (history.PredictTimeToThreshold(threshold, ms, PowerMonitor::rateWindowMs)) {
+                std::cout << " " << threshold << "% in " << ms / 60000 << "m";
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "wakeups: " << monitor.Wakeups() << " (" << monitor.WakeupsPerHour() << "/hour)" << std::endl;
+    if (audio) {
+        std::cout << "audio: " << beepAlerts << " beep alerts, " << audio->Dropped() << " dropped" << std::endl;
+    }
+    if (!csvPath.empty()) {
+        std::ofstream out(csvPath);
+        monitor.GetHistory().WriteCsv(out);
+    }
+    if (!binPath.empty()) {
+        std::ofstream out(binPath, std::ios::binary);
+        monitor.GetHistory().WriteBinary(out);
     }
 
+    // A replayed trace ends by failing the next read.
+    if (result == MonitorResult::Error && replayPath.empty()) {
+        std::cerr << "Failed to Get Battery Status" << std::endl;
+        return 1;
+    }
     return 0;
 }
+
+#endif
@@ -0,0 +1,172 @@
+#include "FleetMonitor.h"
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Heap bytes behind a string; short strings live inside the object itself.
+std::size_t HeapBytes(const std::string& s) {
+    // Raw < and >= on pointers into different objects are unspecified;
+    // std::less gives a total order.
+    const char* object = reinterpret_cast<const char*>(&s);
+    std::less<const char*> before;
+    bool inline_ = !before(s.data(), object) && before(s.data(), object + sizeof(s));
+    return inline_ ? 0 : s.capacity() + 1;
+}
+
+}
+
+FleetMonitor::FleetMonitor(std::chrono::milliseconds pollInterval, std::chrono::milliseconds realertInterval, std::chrono::milliseconds tick)
+    : pollInterval(pollInterval), realertInterval(realertInterval), tick(tick) {
+    if (tick.count() <= 0 || pollInterval.count() <= 0 || realertInterval.count() <= 0) {
+        throw std::invalid_argument("FleetMonitor intervals must be positive");
+    }
+    std::size_t slots = static_cast<std::size_t>(std::max(pollInterval, realertInterval) / tick) + 2;
+    wheel.resize(slots);
+}
+
+std::size_t FleetMonitor::Discover(const std::string& root) {
+    std::size_t before = sources.size();
+    std::error_code ec;
+    for (const auto& device : fs::directory_iterator(root, ec)) {
+        if (!device.is_directory(ec)) {
+            continue;
+        }
+
+        Source source;
+        source.dir = device.path().string();
+        source.supplies = ListPowerSupplies(source.dir);
+        if (source.supplies.empty()) {
+            continue;
+        }
+        source.supplies.shrink_to_fit();
+        sources.push_back(std::move(source));
+    }
+
+    // Spread the new sources round-robin over the slots of one poll interval.
+    std::size_t slotsPerPoll = std::max<std::size_t>(1, static_cast<std::size_t>(pollInterval / tick));
+    for (std::size_t i = before; i < sources.size(); ++i) {
+        ScheduleTicks(static_cast<uint32_t>(i), 1 + (i - before) % slotsPerPoll);
+    }
+    return sources.size() - before;
+}
+
+void FleetMonitor::Schedule(uint32_t source, std::chrono::milliseconds delay) {
+    ScheduleTicks(source, static_cast<std::size_t>((delay + tick - std::chrono::milliseconds(1)) / tick));
+}
+
+void FleetMonitor::ScheduleTicks(uint32_t source, std::size_t ticks) {
+    ticks = std::min(std::max<std::size_t>(ticks, 1), wheel.size() - 1);
+    wheel[(cursor + ticks) % wheel.size()].push_back(source);
+}
+
+void FleetMonitor::Run(Clock::time_point until, const std::function<void(const AlertBatch&)>& onAlerts) {
+    AlertBatch batch;
+    std::vector<uint32_t> due;
+    auto origin = Clock::now();
+    long long ticksDone = 0;
+    auto now = origin;
+    while (now < until) {
+        // Take every slot that has come due since the last pass, so a slow
+        // tick is caught up instead of pushing the whole schedule back. All of
+        // them are emptied before anything is rescheduled, so no source can
+        // land in a slot still waiting to be drained.
+        long long current = (now - origin) / tick;
+        std::size_t behind = static_cast<std::size_t>(std::min<long long>(std::max(current - ticksDone, 0LL), wheel.size() - 1));
+        for (std::size_t k = 0; k <= behind; ++k) {
+            std::vector<uint32_t>& slot = wheel[(cursor + k) % wheel.size()];
+            due.insert(due.end(), slot.begin(), slot.end());
+            slot.clear();
+        }
+        cursor = (cursor + behind) % wheel.size();
+        ticksDone = std::max(ticksDone, current);
+
+        for (uint32_t index : due) {
+            Source& source = sources[index];
+            ++polls;
+
+            FleetAlert alert;
+            if (!ReadPowerSupplies(source.dir, source.supplies, scratchPath, alert.state)) {
+                ++failures;
+                Schedule(index, pollInterval);
+                continue;
+            }
+
+            alert.decision = EvaluateThresholds(alert.state, source.prevBatteryPercent);
+            auto delay = pollInterval;
+            if (alert.decision.showPercent) {
+                if (now >= source.nextAlertAllowed) {
+                    source.prevBatteryPercent = alert.state.batteryPercent;
+                    source.nextAlertAllowed = now + realertInterval;
+                    alert.source = index;
+                    batch.push_back(alert);
+                }
+                else {
+                    delay = std::min(delay, std::chrono::duration_cast<std::chrono::milliseconds>(source.nextAlertAllowed - now));
+                }
+            }
+            Schedule(index, delay);
+        }
+        due.clear();
+
+        if (!batch.empty()) {
+            onAlerts(batch);
+            batch.clear();
+        }
+
+        cursor = (cursor + 1) % wheel.size();
+        ++ticksDone;
+        std::this_thread::sleep_until(std::min<Clock::time_point>(origin + tick * ticksDone, until));
+        now = Clock::now();
+    }
+}
+
+std::size_t FleetMonitor::MemoryBytes() const {
+    std::size_t bytes = sources.capacity() * sizeof(Source) + wheel.capacity() * sizeof(wheel[0]);
+    for (const Source& source : sources) {
+        bytes += HeapBytes(source.dir) + source.supplies.capacity() * sizeof(PowerSupplyEntry);
+        for (const PowerSupplyEntry& supply : source.supplies) {
+            bytes += HeapBytes(supply.name);
+        }
+    }
+    for (const auto& slot : wheel) {
+        bytes += slot.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+bool GenerateFleetTree(const std::string& root, std::size_t count) {
+    std::error_code ec;
+    for (std::size_t i = 0; i < count; ++i) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "dev%05zu", i);
+        fs::path device = fs::path(root) / name;
+        fs::create_directories(device / "BAT0", ec);
+        fs::create_directories(device / "AC", ec);
+        if (ec) {
+            return false;
+        }
+
+        // A mix of levels and plug states so every threshold rule gets hit.
+        int capacity = static_cast<int>((i * 37) % 101);
+        bool online = i % 3 == 0;
+        std::ofstream(device / "BAT0" / "type") << "Battery\n";
+        std::ofstream(device / "BAT0" / "capacity") << capacity << "\n";
+        std::ofstream(device / "BAT0" / "status") << (online ? "Charging" : "Discharging") << "\n";
+        std::ofstream(device / "AC" / "type") << "Mains\n";
+        std::ofstream(device / "AC" / "online") << (online ? 1 : 0) << "\n";
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,88 @@
+/*
+FleetMonitor: watches many battery-backed devices from one process.
+
+Each subdirectory of the fleet root is one device whose contents are laid out
+like /sys/class/power_supply (BAT0/, AC/, ...). Every device is polled on a
+single timer wheel, the same thresholds as PowerMonitor are applied to each,
+and the alerts raised during one tick are handed over together.
+
+The wheel has one slot per tick of the longest delay ever scheduled (the poll
+or re-alert interval), so a source is always placed less than one revolution
+ahead and no per-entry round counting is needed. Sources start spread
+round-robin over the slots of one poll interval to keep the per-tick load
+flat, so the tick should be a fraction of the poll interval. A tick that
+overruns is caught up on the next pass rather than delaying later ones.
+*/
+
+#pragma once
+
+#ifndef _WIN32
+
+#include "PowerMonitor.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct FleetAlert {
+    std::size_t source = 0;
+    PowerState state;
+    AlertDecision decision;
+};
+
+class FleetMonitor {
+public:
+    using Clock = std::chrono::steady_clock;
+    using AlertBatch = std::vector<FleetAlert>;
+
+    // Throws std::invalid_argument unless all three intervals are positive.
+    explicit FleetMonitor(std::chrono::milliseconds pollInterval = std::chrono::minutes(1),
+        std::chrono::milliseconds realertInterval = std::chrono::minutes(1),
+        std::chrono::milliseconds tick = std::chrono::seconds(1));
+
+    // Adds every device directory under root. Returns how many were found.
+    std::size_t Discover(const std::string& root);
+
+    std::size_t Size() const { return sources.size(); }
+    const std::string& Path(std::size_t source) const { return sources[source].dir; }
+
+    // Polls due sources tick by tick until `until`, calling onAlerts once for
+    // each tick that raised any.
+    void Run(Clock::time_point until, const std::function<void(const AlertBatch&)>& onAlerts);
+
+    long long Polls() const { return polls; }
+    long long Failures() const { return failures; }
+
+    // Heap and inline bytes held for the sources and the wheel.
+    std::size_t MemoryBytes() const;
+
+private:
+    struct Source {
+        std::string dir;
+        std::vector<PowerSupplyEntry> supplies;
+        int prevBatteryPercent = 0;
+        Clock::time_point nextAlertAllowed;
+    };
+
+    void Schedule(uint32_t source, std::chrono::milliseconds delay);
+    void ScheduleTicks(uint32_t source, std::size_t ticks);
+
+    std::chrono::milliseconds pollInterval;
+    std::chrono::milliseconds realertInterval;
+    std::chrono::milliseconds tick;
+    std::vector<Source> sources;
+    std::vector<std::vector<uint32_t>> wheel;
+    std::size_t cursor = 0;
+    std::string scratchPath;
+    long long polls = 0;
+    long long failures = 0;
+};
+
+// Writes `count` fake devices (one battery and one AC adapter each) under root
+// for exercising and benchmarking fleet mode.
+bool GenerateFleetTree(const std::string& root, std::size_t count);
+
+#endif
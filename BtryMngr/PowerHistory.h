@@ -0,0 +1,141 @@
+/*
+PowerHistory: fixed-size ring buffer of timestamped power samples.
+
+The buffer lives inline (no heap allocation) and overwrites the oldest sample
+when full. From the samples since the last plug/unplug it estimates the
+charge or discharge rate with a least-squares fit and predicts when a given
+percentage will be reached.
+
+Timestamps are Unix milliseconds. History can be written as CSV (one
+"timestamp_ms,percent,ac" line per sample, the same format the replay source
+reads) or as a compact binary stream: the
+4-byte tag "BTRH", a little-endian uint32 sample count, then 10 bytes per
+sample (int64 timestamp_ms, uint8 percent, uint8 ac).
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+struct PowerSample {
+    int64_t timestampMs = 0;  // Unix time
+    uint8_t batteryPercent = 0;
+    bool isConnectedToAC = false;
+};
+
+template <std::size_t Capacity>
+class PowerHistory {
+public:
+    static_assert(Capacity >= 2, "PowerHistory needs room for at least two samples");
+
+    void Push(const PowerSample& sample) {
+        samples[(first + count) % Capacity] = sample;
+        if (count < Capacity) {
+            ++count;
+        }
+        else {
+            first = (first + 1) % Capacity;
+        }
+    }
+
+    std::size_t Size() const { return count; }
+
+    // 0 is the oldest sample still held.
+    const PowerSample& operator[](std::size_t i) const { return samples[(first + i) % Capacity]; }
+
+    const PowerSample& Latest() const { return (*this)[count - 1]; }
+
+    // Percent per hour over the samples within windowMs of the latest one that
+    // share its AC state; negative while discharging. Returns false when there
+    // is not enough history for a fit.
+    bool EstimateRate(double& percentPerHour, int64_t windowMs) const {
+        if (count < 2) {
+            return false;
+        }
+
+        const PowerSample& latest = Latest();
+        std::size_t begin = count - 1;
+        while (begin > 0) {
+            const PowerSample& prev = (*this)[begin - 1];
+            // A wall-clock step backwards also ends the trend.
+            if (prev.isConnectedToAC != latest.isConnectedToAC || prev.timestampMs > (*this)[begin].timestampMs
+                || latest.timestampMs - prev.timestampMs > windowMs) {
+                break;
+            }
+            --begin;
+        }
+        std::size_t n = count - begin;
+        if (n < 2) {
+            return false;
+        }
+
+        // Fit against hours relative to the latest sample to keep the sums small.
+        double sumT = 0, sumP = 0, sumTT = 0, sumTP = 0;
+        for (std::size_t i = begin; i < count; ++i) {
+            double t = ((*this)[i].timestampMs - latest.timestampMs) / 3600000.0;
+            double p = (*this)[i].batteryPercent;
+            sumT += t;
+            sumP += p;
+            sumTT += t * t;
+            sumTP += t * p;
+        }
+        double denominator = n * sumTT - sumT * sumT;
+        if (denominator <= 0) {
+            return false;
+        }
+        percentPerHour = (n * sumTP - sumT * sumP) / denominator;
+        return true;
+    }
+
+    // Milliseconds from the latest sample until the battery is expected to
+    // reach `threshold`. Returns false if the current trend never gets there.
+    bool PredictTimeToThreshold(int threshold, int64_t& ms, int64_t windowMs) const {
+        double rate;
+        if (!EstimateRate(rate, windowMs)) {
+            return false;
+        }
+        double distance = threshold - static_cast<double>(Latest().batteryPercent);
+        if (distance == 0) {
+            ms = 0;
+            return true;
+        }
+        if (rate == 0 || (distance > 0) != (rate > 0)) {
+            return false;
+        }
+        ms = static_cast<int64_t>(distance / rate * 3600000.0);
+        return true;
+    }
+
+    void WriteCsv(std::ostream& out) const {
+        out << "timestamp_ms,percent,ac\n";
+        for (std::size_t i = 0; i < count; ++i) {
+            const PowerSample& s = (*this)[i];
+            out << s.timestampMs << ',' << static_cast<int>(s.batteryPercent) << ',' << (s.isConnectedToAC ? 1 : 0) << '\n';
+        }
+    }
+
+    void WriteBinary(std::ostream& out) const {
+        out.write("BTRH", 4);
+        WriteLittleEndian(out, static_cast<uint32_t>(count), 4);
+        for (std::size_t i = 0; i < count; ++i) {
+            const PowerSample& s = (*this)[i];
+            WriteLittleEndian(out, static_cast<uint64_t>(s.timestampMs), 8);
+            out.put(static_cast<char>(s.batteryPercent));
+            out.put(s.isConnectedToAC ? 1 : 0);
+        }
+    }
+
+private:
+    static void WriteLittleEndian(std::ostream& out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; ++i) {
+            out.put(static_cast<char>((value >> (8 * i)) & 0xff));
+        }
+    }
+
+    std::array<PowerSample, Capacity> samples{};
+    std::size_t first = 0;
+    std::size_t count = 0;
+};
@@ -0,0 +1,85 @@
+#include "PowerMonitor.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+AlertDecision EvaluateThresholds(const PowerState& state, int prevBatteryPercent) {
+    int currentBatteryPercent = state.batteryPercent;
+    bool isConnectedToAC = state.isConnectedToAC;
+    bool isBatteryPercentDifferenceSmall = std::abs(currentBatteryPercent - prevBatteryPercent) < 5;
+
+    bool inNormalRange = currentBatteryPercent < 95 && currentBatteryPercent > 31;
+    bool connectedToACAndLowBattery = isConnectedToAC && currentBatteryPercent < 32;
+    bool notConnectedToACAndHighBattery = !isConnectedToAC && currentBatteryPercent > 94;
+    bool notConnectedToACAndLowBattery = !isConnectedToAC && currentBatteryPercent < 32;
+    bool connectedToACAndHighBattery = isConnectedToAC && currentBatteryPercent > 94;
+    bool safezone = inNormalRange || connectedToACAndLowBattery || notConnectedToACAndHighBattery;
+
+    AlertDecision decision;
+    if (safezone && isBatteryPercentDifferenceSmall) {
+        return decision;
+    }
+    decision.showPercent = true;
+    decision.beep = notConnectedToACAndLowBattery || connectedToACAndHighBattery;
+    return decision;
+}
+
+PowerMonitor::PowerMonitor(PowerSource& source, std::chrono::milliseconds maxWait, std::chrono::milliseconds realertInterval)
+    : source(source), maxWait(maxWait), realertInterval(realertInterval), started(source.Now()), nextAlertAllowed(started) {
+}
+
+std::chrono::milliseconds PowerMonitor::TimeToNextThreshold(const PowerState& state) const {
+    // Don't trust a prediction so short that it would turn into busy polling.
+    const int64_t minWaitMs = 30 * 1000;
+
+    int thresholds[] = { prevBatteryPercent - 5, prevBatteryPercent + 5, state.isConnectedToAC ? 95 : 31 };
+    int64_t best = maxWait.count();
+    for (int threshold : thresholds) {
+        int64_t ms;
+        if (history.PredictTimeToThreshold(threshold, ms, rateWindowMs)) {
+            best = std::min(best, std::max(ms, minWaitMs));
+        }
+    }
+    return std::chrono::milliseconds(best);
+}
+
+MonitorResult PowerMonitor::WaitForAlert(PowerState& state, AlertDecision& decision, Clock::time_point until) {
+    while (true) {
+        if (!source.GetStatus(state)) {
+            return MonitorResult::Error;
+        }
+
+        auto now = source.Now();
+        PowerSample sample;
+        sample.timestampMs = source.UnixTimeMs();
+        sample.batteryPercent = static_cast<uint8_t>(state.batteryPercent);
+        sample.isConnectedToAC = state.isConnectedToAC;
+        // Returning an alert and being called again reads the same instant twice.
+        if (history.Size() == 0 || history.Latest().timestampMs != sample.timestampMs) {
+            history.Push(sample);
+        }
+
+        decision = EvaluateThresholds(state, prevBatteryPercent);
+        if (decision.showPercent && now >= nextAlertAllowed) {
+            prevBatteryPercent = state.batteryPercent;
+            nextAlertAllowed = now + realertInterval;
+            return MonitorResult::Alert;
+        }
+        if (now >= until) {
+            return MonitorResult::Timeout;
+        }
+
+        // While an alert is pending but rate limited, still wake on events so
+        // plugging in or out is seen straight away; otherwise wait for the
+        // backend to report something or the trend to reach a threshold.
+        auto wake = decision.showPercent ? nextAlertAllowed : now + TimeToNextThreshold(state);
+        wake = std::min(wake, until);
+        source.WaitForChange(std::chrono::duration_cast<std::chrono::milliseconds>(wake - now) + std::chrono::milliseconds(1));
+        ++wakeups;
+    }
+}
+
+double PowerMonitor::WakeupsPerHour() const {
+    double hours = std::chrono::duration<double, std::ratio<3600>>(source.Now() - started).count();
+    return hours > 0 ? wakeups / hours : 0;
+}
@@ -0,0 +1,64 @@
+/*
+PowerMonitor: applies the battery thresholds to a PowerSource and blocks until
+an alert is due, instead of polling on a fixed interval.
+
+The alert ranges are the ones BtryMngr has always used: nag when the battery is
+below 32% on battery power or above 94% on AC power, and show the percentage
+whenever it has moved 5 or more points since the last message.
+
+Every status read is recorded in a PowerHistory. While nothing is due, the
+monitor sleeps until the charge/discharge trend predicts the next threshold
+crossing (bounded by maxWait), so a missed notification costs at most that.
+*/
+
+#pragma once
+
+#include "PowerHistory.h"
+#include "PowerSource.h"
+
+#include <chrono>
+
+struct AlertDecision {
+    bool showPercent = false;
+    bool beep = false;
+};
+
+AlertDecision EvaluateThresholds(const PowerState& state, int prevBatteryPercent);
+
+enum class MonitorResult { Alert, Timeout, Error };
+
+class PowerMonitor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // maxWait bounds how long to trust the backend when nothing is reported;
+    // realertInterval limits how often an unresolved alert is repeated.
+    explicit PowerMonitor(PowerSource& source,
+        std::chrono::milliseconds maxWait = std::chrono::minutes(10),
+        std::chrono::milliseconds realertInterval = std::chrono::minutes(1));
+
+    // Blocks until the thresholds call for an alert, the source fails, or
+    // `until` passes.
+    MonitorResult WaitForAlert(PowerState& state, AlertDecision& decision, Clock::time_point until = Clock::time_point::max());
+
+    long long Wakeups() const { return wakeups; }
+    double WakeupsPerHour() const;
+
+    using History = PowerHistory<256>;
+    const History& GetHistory() const { return history; }
+
+    // The trend window used for rate estimates.
+    static constexpr int64_t rateWindowMs = 30 * 60 * 1000;
+
+private:
+    std::chrono::milliseconds TimeToNextThreshold(const PowerState& state) const;
+
+    PowerSource& source;
+    std::chrono::milliseconds maxWait;
+    std::chrono::milliseconds realertInterval;
+    Clock::time_point started;
+    Clock::time_point nextAlertAllowed;
+    int prevBatteryPercent = 0;
+    long long wakeups = 0;
+    History history;
+};
@@ -0,0 +1,396 @@
+#include "PowerSource.h"
+#include "PowerHistory.h"
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+// Time left until deadline, rounded up so a sub-millisecond remainder still
+// sleeps instead of spinning.
+std::chrono::milliseconds RemainingUntil(std::chrono::steady_clock::time_point deadline) {
+    auto left = deadline - std::chrono::steady_clock::now();
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(left);
+    return ms < left ? ms + std::chrono::milliseconds(1) : ms;
+}
+
+}
+
+#ifdef _WIN32
+
+#include <algorithm>
+#define NOMINMAX
+#include <windows.h>
+
+namespace {
+
+// Receives power notifications on a hidden window owned by the calling
+// thread. WaitForChange() pumps that thread's message queue.
+class WindowsPowerSource : public PowerSource {
+public:
+    WindowsPowerSource() {
+        HINSTANCE hInstance = GetModuleHandle(nullptr);
+
+        WNDCLASS wc = { 0 };
+        wc.lpfnWndProc = NotifyProc;
+        wc.hInstance = hInstance;
+        wc.lpszClassName = L"BtryPowerNotify";
+        RegisterClass(&wc);
+
+        // Not a message-only window: those do not receive WM_POWERBROADCAST.
+        hWnd = CreateWindowEx(WS_EX_TOOLWINDOW, wc.lpszClassName, L"", WS_POPUP,
+            0, 0, 0, 0, nullptr, nullptr, hInstance, nullptr);
+        if (hWnd) {
+            SetWindowLongPtr(hWnd, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
+            acdcNotify = RegisterPowerSettingNotification(hWnd, &GUID_ACDC_POWER_SOURCE, DEVICE_NOTIFY_WINDOW_HANDLE);
+            percentNotify = RegisterPowerSettingNotification(hWnd, &GUID_BATTERY_PERCENTAGE_REMAINING, DEVICE_NOTIFY_WINDOW_HANDLE);
+        }
+    }
+
+    ~WindowsPowerSource() override {
+        if (acdcNotify) {
+            UnregisterPowerSettingNotification(acdcNotify);
+        }
+        if (percentNotify) {
+            UnregisterPowerSettingNotification(percentNotify);
+        }
+        if (hWnd) {
+            DestroyWindow(hWnd);
+        }
+        UnregisterClass(L"BtryPowerNotify", GetModuleHandle(nullptr));
+    }
+
+    bool GetStatus(PowerState& state) override {
+        SYSTEM_POWER_STATUS sps;
+        if (GetSystemPowerStatus(&sps) == 0) {
+            return false;
+        }
+        state.batteryPercent = sps.BatteryLifePercent;
+        state.isConnectedToAC = sps.ACLineStatus == 1;
+        return true;
+    }
+
+    bool WaitForChange(std::chrono::milliseconds timeout) override {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        changed = false;
+        while (true) {
+            MSG msg;
+            while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+                TranslateMessage(&msg);
+                DispatchMessage(&msg);
+            }
+            if (changed) {
+                return true;
+            }
+
+            auto remaining = RemainingUntil(deadline);
+            if (remaining.count() <= 0) {
+                return false;
+            }
+            MsgWaitForMultipleObjects(0, nullptr, FALSE, static_cast<DWORD>(std::min<long long>(remaining.count(), INFINITE - 1)), QS_ALLINPUT);
+        }
+    }
+
+private:
+    static LRESULT CALLBACK NotifyProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam) {
+        if (message == WM_POWERBROADCAST && (wParam == PBT_POWERSETTINGCHANGE || wParam == PBT_APMPOWERSTATUSCHANGE)) {
+            auto* self = reinterpret_cast<WindowsPowerSource*>(GetWindowLongPtr(hWnd, GWLP_USERDATA));
+            if (self) {
+                self->changed = true;
+            }
+            return TRUE;
+        }
+        return DefWindowProc(hWnd, message, wParam, lParam);
+    }
+
+    HWND hWnd = nullptr;
+    HPOWERNOTIFY acdcNotify = nullptr;
+    HPOWERNOTIFY percentNotify = nullptr;
+    bool changed = false;
+};
+
+}
+
+std::unique_ptr<PowerSource> CreateSystemPowerSource() {
+    return std::make_unique<WindowsPowerSource>();
+}
+
+#else
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/inotify.h>
+#include <linux/netlink.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Reads a short sysfs attribute into buffer without allocating; trailing
+// newline stripped.
+bool ReadAttribute(const std::string& path, char* buffer, std::size_t size) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    ssize_t len = read(fd, buffer, size - 1);
+    close(fd);
+    if (len < 0) {
+        return false;
+    }
+    while (len > 0 && (buffer[len - 1] == '\n' || buffer[len - 1] == ' ')) {
+        --len;
+    }
+    buffer[len] = '\0';
+    return true;
+}
+
+// Reads /sys/class/power_supply (or a copy of its layout). The real tree is
+// woken by kernel uevents; sysfs files do not generate inotify events, so the
+// fake tree is woken by inotify instead.
+class SysfsPowerSource : public PowerSource {
+public:
+    SysfsPowerSource(const std::string& root, bool fakeTree) : root(root) {
+        if (fakeTree) {
+            notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (notifyFd >= 0) {
+                const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE;
+                inotify_add_watch(notifyFd, root.c_str(), mask);
+                std::error_code ec;
+                for (const auto& entry : fs::directory_iterator(root, ec)) {
+                    if (entry.is_directory(ec)) {
+                        inotify_add_watch(notifyFd, entry.path().c_str(), mask);
+                    }
+                }
+            }
+        }
+        else {
+            notifyFd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+            if (notifyFd >= 0) {
+                sockaddr_nl addr = {};
+                addr.nl_family = AF_NETLINK;
+                addr.nl_groups = 1;  // kernel uevent multicast group
+                if (bind(notifyFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+                    close(notifyFd);
+                    notifyFd = -1;
+                }
+            }
+            isNetlink = true;
+        }
+    }
+
+    ~SysfsPowerSource() override {
+        if (notifyFd >= 0) {
+            close(notifyFd);
+        }
+    }
+
+    bool GetStatus(PowerState& state) override {
+        // Listed on every read so supplies that come and go are picked up.
+        return ReadPowerSupplies(root, ListPowerSupplies(root), pathBuffer, state);
+    }
+
+    bool WaitForChange(std::chrono::milliseconds timeout) override {
+        if (notifyFd < 0) {
+            std::this_thread::sleep_for(timeout);
+            return false;
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        std::vector<char> buffer(8192);
+        while (true) {
+            auto remaining = RemainingUntil(deadline);
+            if (remaining.count() <= 0) {
+                return false;
+            }
+
+            pollfd pfd = { notifyFd, POLLIN, 0 };
+            int pollMs = static_cast<int>(std::min<long long>(remaining.count(), INT_MAX));
+            if (poll(&pfd, 1, pollMs) <= 0) {
+                continue;
+            }
+
+            ssize_t len = read(notifyFd, buffer.data(), buffer.size() - 1);
+            if (len <= 0) {
+                continue;
+            }
+            buffer[len] = '\0';
+            if (!isNetlink) {
+                // Drain whatever else the write produced so one update is one wakeup.
+                while (read(notifyFd, buffer.data(), buffer.size()) > 0) {
+                }
+                return true;
+            }
+
+            // A uevent is a sequence of NUL-separated KEY=VALUE strings.
+            for (ssize_t i = 0; i < len; i += std::char_traits<char>::length(&buffer[i]) + 1) {
+                if (std::string(&buffer[i]) == "SUBSYSTEM=power_supply") {
+                    return true;
+                }
+            }
+        }
+    }
+
+private:
+    std::string root;
+    std::string pathBuffer;
+    int notifyFd = -1;
+    bool isNetlink = false;
+};
+
+}
+
+std::vector<PowerSupplyEntry> ListPowerSupplies(const std::string& dir) {
+    std::vector<PowerSupplyEntry> supplies;
+    char type[32];
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec)) {
+        if (!ReadAttribute((entry.path() / "type").string(), type, sizeof(type))) {
+            continue;
+        }
+        bool isBattery = std::strcmp(type, "Battery") == 0;
+        if (isBattery || std::strcmp(type, "Mains") == 0 || std::strcmp(type, "USB") == 0) {
+            PowerSupplyEntry supply;
+            supply.name = entry.path().filename().string();
+            supply.isBattery = isBattery;
+            supplies.push_back(std::move(supply));
+        }
+    }
+    return supplies;
+}
+
+bool ReadPowerSupplies(const std::string& dir, const std::vector<PowerSupplyEntry>& supplies, std::string& pathBuffer, PowerState& state) {
+    int capacitySum = 0;
+    int batteries = 0;
+    bool sawMains = false;
+    bool mainsOnline = false;
+    bool charging = false;
+    char value[32];
+
+    for (const PowerSupplyEntry& supply : supplies) {
+        pathBuffer.assign(dir).append("/").append(supply.name).append("/");
+        std::size_t base = pathBuffer.size();
+        if (supply.isBattery) {
+            pathBuffer.append("capacity");
+            if (!ReadAttribute(pathBuffer, value, sizeof(value)) || value[0] == '\0') {
+                continue;
+            }
+            capacitySum += std::atoi(value);
+            ++batteries;
+            pathBuffer.resize(base);
+            pathBuffer.append("status");
+            if (ReadAttribute(pathBuffer, value, sizeof(value))) {
+                charging = charging || std::strcmp(value, "Charging") == 0 || std::strcmp(value, "Full") == 0;
+            }
+        }
+        else {
+            sawMains = true;
+            pathBuffer.append("online");
+            mainsOnline = mainsOnline || (ReadAttribute(pathBuffer, value, sizeof(value)) && std::strcmp(value, "1") == 0);
+        }
+    }
+    if (batteries == 0) {
+        return false;
+    }
+
+    state.batteryPercent = capacitySum / batteries;
+    state.isConnectedToAC = sawMains ? mainsOnline : charging;
+    return true;
+}
+
+std::unique_ptr<PowerSource> CreateSysfsPowerSource(const std::string& root, bool fakeTree) {
+    return std::make_unique<SysfsPowerSource>(root, fakeTree);
+}
+
+std::unique_ptr<PowerSource> CreateSystemPowerSource() {
+    return CreateSysfsPowerSource("/sys/class/power_supply", false);
+}
+
+#endif
+
+namespace {
+
+class ReplayPowerSource : public PowerSource {
+public:
+    explicit ReplayPowerSource(const std::string& csvPath) {
+        std::ifstream file(csvPath);
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream fields(line);
+            long long timestampMs;
+            int percent, ac;
+            char comma1, comma2;
+            if (fields >> timestampMs >> comma1 >> percent >> comma2 >> ac) {
+                PowerSample sample;
+                sample.timestampMs = timestampMs;
+                sample.batteryPercent = static_cast<uint8_t>(percent);
+                sample.isConnectedToAC = ac != 0;
+                trace.push_back(sample);
+            }
+        }
+        if (!trace.empty()) {
+            now = TimeOf(trace[0]);
+        }
+    }
+
+    bool GetStatus(PowerState& state) override {
+        if (next >= trace.size() && (trace.empty() || finished)) {
+            return false;
+        }
+        // Apply every sample the virtual clock has reached.
+        while (next < trace.size() && TimeOf(trace[next]) <= now) {
+            ++next;
+        }
+        const PowerSample& current = trace[next - 1];
+        state.batteryPercent = current.batteryPercent;
+        state.isConnectedToAC = current.isConnectedToAC;
+        return true;
+    }
+
+    // Like a real backend, only wakes for a row whose percent or plug state
+    // differs from what GetStatus last returned; repeated rows are skipped.
+    bool WaitForChange(std::chrono::milliseconds timeout) override {
+        auto target = now + timeout;
+        for (std::size_t i = next; i < trace.size() && TimeOf(trace[i]) <= target; ++i) {
+            if (next == 0 || trace[i].batteryPercent != trace[next - 1].batteryPercent ||
+                trace[i].isConnectedToAC != trace[next - 1].isConnectedToAC) {
+                now = TimeOf(trace[i]);
+                return true;
+            }
+        }
+        finished = trace.empty() || TimeOf(trace.back()) <= target;
+        now = target;
+        return false;
+    }
+
+    std::chrono::steady_clock::time_point Now() const override { return now; }
+
+    long long UnixTimeMs() const override {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+    }
+
+private:
+    static std::chrono::steady_clock::time_point TimeOf(const PowerSample& sample) {
+        return std::chrono::steady_clock::time_point(std::chrono::milliseconds(sample.timestampMs));
+    }
+
+    std::vector<PowerSample> trace;
+    std::size_t next = 0;
+    std::chrono::steady_clock::time_point now;
+    bool finished = false;
+};
+
+}
+
+std::unique_ptr<PowerSource> CreateReplayPowerSource(const std::string& csvPath) {
+    return std::make_unique<ReplayPowerSource>(csvPath);
+}
@@ -0,0 +1,75 @@
+/*
+PowerSource: abstraction over where battery/AC state comes from.
+
+Backends block in WaitForChange() until the OS reports a power event (or the
+timeout elapses) instead of the caller waking up on a fixed interval:
+  - Windows: power setting notifications delivered to a hidden window.
+  - Linux: /sys/class/power_supply, woken by uevent netlink messages.
+  - Fake sysfs tree: same layout as /sys/class/power_supply in any directory,
+    woken by inotify when the files are rewritten. Used to drive the monitor
+    headless on Linux.
+  - Replay: a recorded trace on a virtual clock, for exercising the rate
+    estimator at high speed.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct PowerState {
+    int batteryPercent = 0;
+    bool isConnectedToAC = false;
+};
+
+class PowerSource {
+public:
+    virtual ~PowerSource() = default;
+
+    virtual bool GetStatus(PowerState& state) = 0;
+
+    // Blocks until the power state may have changed or the timeout elapses.
+    // Returns true if woken by a power event, false on timeout.
+    virtual bool WaitForChange(std::chrono::milliseconds timeout) = 0;
+
+    // The clock waits are measured on. Replayed traces substitute a virtual
+    // clock so hours of history can be fed through in milliseconds.
+    virtual std::chrono::steady_clock::time_point Now() const { return std::chrono::steady_clock::now(); }
+
+    // Wall-clock time in Unix milliseconds, used to stamp history samples so
+    // exports line up across machines and reboots.
+    virtual long long UnixTimeMs() const {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+};
+
+// The power source of the machine the program runs on.
+std::unique_ptr<PowerSource> CreateSystemPowerSource();
+
+// Replays a trace in the CSV format written by PowerHistory::WriteCsv as fast
+// as the monitor consumes it; the trace's Unix timestamps drive both clocks.
+// GetStatus() fails once the trace is exhausted.
+std::unique_ptr<PowerSource> CreateReplayPowerSource(const std::string& csvPath);
+
+#ifndef _WIN32
+// A directory laid out like /sys/class/power_supply (one subdirectory per
+// supply with "type", "capacity" and "online" files).
+std::unique_ptr<PowerSource> CreateSysfsPowerSource(const std::string& root, bool fakeTree);
+
+// One battery or AC adapter (Mains/USB) in such a directory.
+struct PowerSupplyEntry {
+    std::string name;
+    bool isBattery = false;
+};
+
+std::vector<PowerSupplyEntry> ListPowerSupplies(const std::string& dir);
+
+// Combines the supplies under dir into one state: the average battery
+// capacity, on AC when any adapter is online (or, with no adapter listed,
+// when a battery reports Charging/Full). pathBuffer is scratch space kept by
+// the caller so repeated reads do not allocate. Shared by the single-source
+// and fleet backends.
+bool ReadPowerSupplies(const std::string& dir, const std::vector<PowerSupplyEntry>& supplies, std::string& pathBuffer, PowerState& state);
+#endif
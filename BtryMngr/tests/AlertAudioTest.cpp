@@ -0,0 +1,115 @@
+/*
+Checks the alert audio path without a sound card: the wavetable against the
+std::sin renderer, and the order and drop accounting of AudioQueue.
+*/
+
+#include "../AlertAudio.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void Check(bool ok, const char* what) {
+    if (!ok) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+// What a RecordingSink was asked to play. Outlives the sink, which the queue
+// owns.
+struct Recording {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<const AudioClip*> played;
+    bool released = false;
+};
+
+// Holds up the first clip until released so the test can fill the queue
+// behind it.
+class RecordingSink : public AudioSink {
+public:
+    explicit RecordingSink(Recording& recording) : recording(recording) {}
+
+    void Play(const AudioClip& clip) override {
+        std::unique_lock<std::mutex> lock(recording.mutex);
+        recording.played.push_back(&clip);
+        recording.changed.notify_all();
+        recording.changed.wait(lock, [this] { return recording.released; });
+    }
+
+private:
+    Recording& recording;
+};
+
+void TestWavetable() {
+    ToneCache tones;
+    const double frequencies[] = { 440, 3500, 12345.6 };
+    for (double frequency : frequencies) {
+        const AudioClip& clip = tones.Tone(frequency, 100, 3, 70);
+        AudioClip reference = RenderToneReference(frequency, 100, 3, 70);
+        Check(clip.size() == reference.size(), "wavetable clip length matches the reference");
+        int worst = 0;
+        for (std::size_t i = 0; i < clip.size() && i < reference.size(); ++i) {
+            worst = std::max(worst, std::abs(clip[i] - reference[i]));
+        }
+        Check(worst <= 3, "wavetable samples within 3 LSB of std::sin");
+    }
+
+    Check(&tones.Beeps(2) == &tones.Beeps(2), "clips are cached");
+    Check(tones.Beeps(2).size() == 2 * (4410 + 3087), "Beeps(2) is two 100 ms beeps with a 70 ms gap");
+    Check(tones.Tone(3500, 100, 0).empty(), "no repeats gives an empty clip");
+    Check(tones.Tone(3500, 0).empty(), "no duration gives an empty clip");
+    Check(tones.Tone(0, 100).empty(), "no frequency gives an empty clip");
+    Check(tones.Tone(3500, 100, 1, -1).empty(), "a negative gap gives an empty clip");
+}
+
+void TestQueue() {
+    const std::size_t maxPending = 4;
+    const std::size_t extra = 3;
+    std::vector<AudioClip> clips(1 + maxPending + extra, AudioClip(1));
+
+    Recording recording;
+    {
+        AudioQueue audio(std::make_unique<RecordingSink>(recording), maxPending);
+        Check(audio.Enqueue(clips[0]), "first clip accepted");
+        {
+            std::unique_lock<std::mutex> lock(recording.mutex);
+            recording.changed.wait(lock, [&] { return !recording.played.empty(); });
+        }
+
+        // The first clip is playing, so exactly maxPending more fit behind it.
+        std::size_t accepted = 0;
+        for (std::size_t i = 1; i < clips.size(); ++i) {
+            accepted += audio.Enqueue(clips[i]) ? 1 : 0;
+        }
+        Check(accepted == maxPending, "queue accepts up to maxPending clips");
+        Check(audio.Dropped() == extra, "Dropped() counts only the clips beyond maxPending");
+
+        std::lock_guard<std::mutex> lock(recording.mutex);
+        recording.released = true;
+        recording.changed.notify_all();
+    }
+
+    const std::vector<const AudioClip*>& played = recording.played;
+    Check(played.size() == 1 + maxPending, "every accepted clip is played before the queue is destroyed");
+    for (std::size_t i = 0; i < played.size(); ++i) {
+        Check(played[i] == &clips[i], "clips play in the order they were queued");
+    }
+}
+
+}
+
+int main() {
+    TestWavetable();
+    TestQueue();
+    if (failures == 0) {
+        std::cout << "all audio checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,27 @@
+#!/bin/sh
+# Generates a fleet of fake devices and runs fleet mode over it for a second.
+# Every poll must succeed, the generated levels must raise alerts, and the
+# sources must be spread over the wheel so those alerts come in more than one
+# batch rather than all on the same tick.
+#
+# usage: check_fleet.sh <btry> <fleet dir>
+
+rm -rf "$2"
+"$1" --fleet "$2" --generate 200 --poll-ms 100 --seconds 1 > "$2.out" || { cat "$2.out"; echo "btry failed"; exit 1; }
+grep -v '^/' "$2.out"
+
+awk '
+/^sources:/ { sources = $2 }
+/^polls:/ {
+    polls = $2 + 0; failures = $4 + 0; alerts = $6 + 0; batches = $8 + 0
+    summary = 1
+}
+END {
+    if (!summary) { print "no summary"; exit 1 }
+    if (sources != 200) { print "want 200 sources, found " sources; failed = 1 }
+    if (polls < sources) { print "only " polls " polls"; failed = 1 }
+    if (failures != 0) { print failures " failed polls"; failed = 1 }
+    if (alerts == 0) { print "no alerts"; failed = 1 }
+    if (batches < 2) { print "all alerts in " batches " batch"; failed = 1 }
+    exit failed
+}' "$2.out"
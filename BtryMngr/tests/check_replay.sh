@@ -0,0 +1,59 @@
+#!/bin/sh
+# Replays a recorded trace through the headless tool and checks the rate
+# estimate and threshold prediction on every alert line against the trace's
+# known rates: -15%/h on battery, +30%/h on AC. The replay only wakes the
+# monitor when the percent or plug state changes, so it must also get by on
+# far fewer wakeups than the trace has rows without missing an alert.
+#
+# usage: check_replay.sh <btry> <trace.csv>
+
+"$1" --replay "$2" | awk -v rows="$(wc -l < "$2")" '
+/^[0-9]+s / {
+    ac = ($0 ~ / AC/)
+    beep = ($2 == "beep")
+    percent = (beep ? $3 : $2) + 0
+    if (beep && !(ac ? percent >= 95 : percent <= 31)) {
+        print "unexpected beep: " $0; failed = 1
+    }
+    if (beep && ac) acBeeps++
+    if (beep && !ac) batteryBeeps++
+    # Between the thresholds every 5% step is reported, no more, no less.
+    if (!beep && n > 0 && lastAc == ac && percent != last + (ac ? 5 : -5)) {
+        print "missed a 5% step after " last "%: " $0; failed = 1
+    }
+    last = percent; lastAc = ac; n++
+}
+/^wakeups:/ { wakeups = $2 }
+/%\/h/ {
+    ac = ($0 ~ / AC /)
+    percent = rate = minutes = ""
+    for (i = 1; i <= NF; i++) {
+        if ($i ~ /^[0-9]+%$/ && percent == "") percent = $i + 0
+        if ($i ~ /%\/h$/) rate = $i + 0
+        if ($i == "in") { threshold = $(i - 1) + 0; minutes = $(i + 1) + 0 }
+    }
+    expected = ac ? 30 : -15
+    if (rate < expected - 1.5 || rate > expected + 1.5) {
+        print "bad rate: " $0; failed = 1
+    }
+    if (minutes != "") {
+        predicted = (threshold - percent) / expected * 60
+        if (minutes < predicted - 5 || minutes > predicted + 5) {
+            print "bad prediction (want ~" int(predicted) "m): " $0; failed = 1
+        }
+        predictions++
+    }
+    if (ac) acLines++; else batteryLines++
+}
+END {
+    if (batteryBeeps == 0 || acBeeps == 0) {
+        print "threshold beeps missing: " batteryBeeps " on battery, " acBeeps " on AC"; failed = 1
+    }
+    if (wakeups == "" || wakeups > rows / 2) {
+        print "too many wakeups for " rows " rows: " wakeups; failed = 1
+    }
+    if (batteryLines < 10 || acLines < 10 || predictions < 20) {
+        print "too few alerts: " batteryLines " battery, " acLines " AC, " predictions " predictions"; failed = 1
+    }
+    exit failed
+}'
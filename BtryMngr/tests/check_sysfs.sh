@@ -0,0 +1,55 @@
+#!/bin/sh
+# Drives the headless tool through a fake /sys/class/power_supply tree: 60% on
+# battery, down to 30% on battery, then 96% on AC. Checks that each step
+# raises its alert (the last two with a beep; 96% on AC keeps nagging every
+# re-alert interval) and that the monitor slept between them instead of
+# polling.
+#
+# usage: check_sysfs.sh <btry> <work dir>
+
+btry=$1
+root=$2/power_supply
+out=$2/sysfs.out
+rm -rf "$root"
+mkdir -p "$root/BAT0" "$root/AC"
+
+# Replace files by rename so the monitor never reads a half-written value.
+put() {
+    echo "$2" > "$root/$1.tmp" && mv "$root/$1.tmp" "$root/$1"
+}
+
+put BAT0/type Battery
+put BAT0/status Discharging
+put BAT0/capacity 60
+put AC/type Mains
+put AC/online 0
+
+"$btry" --sysfs "$root" --realert-ms 400 --max-wait-ms 60000 --seconds 2 > "$out" &
+pid=$!
+sleep 0.5
+put BAT0/capacity 30
+sleep 0.5
+put BAT0/status Charging
+put BAT0/capacity 96
+put AC/online 1
+wait $pid
+status=$?
+cat "$out"
+if [ $status -ne 0 ]; then
+    echo "btry exited with $status"
+    exit 1
+fi
+
+awk '
+/^[0-9]+s / { alerts[++n] = $0 }
+/^wakeups:/ { wakeups = $2 }
+END {
+    if (n < 3) { print "want 3 alerts, got " n; exit 1 }
+    if (alerts[1] !~ /s 60% battery$/) { print "bad first alert: " alerts[1]; failed = 1 }
+    if (alerts[2] !~ /s beep 30% battery/) { print "bad second alert: " alerts[2]; failed = 1 }
+    if (alerts[n] !~ /s beep 96% AC/) { print "bad last alert: " alerts[n]; failed = 1 }
+    # One wakeup per file update and per repeated 96% alert, plus a few for
+    # reads that raced a rename; spinning waits would run into the hundreds.
+    if (wakeups == "" || wakeups > n + 12) { print "too many wakeups: " wakeups; failed = 1 }
+    exit failed
+}' "$out"
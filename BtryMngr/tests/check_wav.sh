@@ -0,0 +1,37 @@
+#!/bin/sh
+# Replays a trace with the alert beeps going to a WAV file, then checks that
+# the file holds one Beeps(2) clip (two 100 ms beeps 70 ms apart at 44.1 kHz,
+# 16-bit mono: 29988 bytes) for every beep alert the queue did not drop, and
+# that the RIFF and data chunk sizes agree with it.
+#
+# usage: check_wav.sh <btry> <trace.csv> <out.wav>
+
+clipBytes=29988
+
+summary=$("$1" --replay "$2" --wav "$3" | grep '^audio:') || { echo "no audio summary"; exit 1; }
+echo "$summary"
+alerts=$(echo "$summary" | awk '{ print $2 }')
+dropped=$(echo "$summary" | awk '{ print $5 }')
+
+u32() {
+    od -An -tu4 -j"$1" -N4 "$3" | tr -d ' '
+}
+riffBytes=$(u32 4 - "$3")
+dataBytes=$(u32 40 - "$3")
+fileBytes=$(wc -c < "$3")
+expected=$(( (alerts - dropped) * clipBytes ))
+
+failed=0
+if [ "$alerts" -eq 0 ]; then
+    echo "no beep alerts"; failed=1
+fi
+if [ "$(head -c 4 "$3")" != RIFF ] || [ "$(dd if="$3" bs=1 skip=36 count=4 2>/dev/null)" != data ]; then
+    echo "not a WAV file"; failed=1
+fi
+if [ "$dataBytes" -ne "$expected" ]; then
+    echo "data chunk is $dataBytes bytes, want $expected"; failed=1
+fi
+if [ "$riffBytes" -ne $(( dataBytes + 36 )) ] || [ "$fileBytes" -ne $(( dataBytes + 44 )) ]; then
+    echo "RIFF size $riffBytes and file size $fileBytes disagree with data size $dataBytes"; failed=1
+fi
+exit $failed